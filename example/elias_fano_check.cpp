@@ -0,0 +1,91 @@
+// randomized check of EliasFanoSequence against std::lower_bound, and of Load on damaged input
+// build: g++ -std=c++11 -I../source elias_fano_check.cpp -o elias_fano_check
+#include "elias_fano_sequence.hpp"
+#include <stdint.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <random>
+
+using namespace std;
+using kaijiang_api::EliasFanoSequence;
+
+static int failures = 0;
+
+#define CHECK(cond) do { if(!(cond)) { cerr << "check failed: " #cond " at line " << __LINE__ << endl; failures++; } } while(0)
+
+int main()
+{
+    std::mt19937_64 rng(20131118);
+    for(int trial = 0; trial < 200; trial++)
+    {
+        size_t count = rng() % 5000;
+        uint64_t universe = 1;
+        switch(trial % 4)
+        {
+            case 0: universe = count * 2 + 1; break;                // dense
+            case 1: universe = 1000000000ULL; break;                 // sparse
+            case 2: universe = ~0ULL; break;                         // full 64 bit range
+            case 3: universe = 8; break;                             // many duplicates
+        }
+        vector<uint64_t> values(count);
+        for(size_t i = 0; i < count; i++)
+            values[i] = rng() % universe;
+        sort(values.begin(), values.end());
+
+        EliasFanoSequence sequence;
+        CHECK(sequence.Build(values));
+        CHECK(sequence.Size() == count);
+        for(size_t i = 0; i < count; i++)
+            CHECK(sequence.Access(i) == values[i]);
+
+        for(int q = 0; q < 1000; q++)
+        {
+            uint64_t value = (q % 2 && count > 0) ? values[rng() % count] + (q % 4 == 1) : rng() % universe;
+            uint64_t found = 0;
+            uint64_t pos = sequence.LowerBound(value, found);
+            uint64_t expected = lower_bound(values.begin(), values.end(), value) - values.begin();
+            CHECK(pos == expected);
+            if(pos < count)
+                CHECK(found == values[pos]);
+        }
+
+        // save/load round trip
+        stringstream stream;
+        CHECK(sequence.Save(stream));
+        string saved = stream.str();
+        EliasFanoSequence loaded;
+        stringstream in(saved);
+        CHECK(loaded.Load(in));
+        for(size_t i = 0; i < count; i++)
+            CHECK(loaded.Access(i) == values[i]);
+
+        // damaged copies must be rejected or still be safe to use
+        for(int d = 0; d < 20 && !saved.empty(); d++)
+        {
+            string damaged = saved;
+            damaged[rng() % damaged.size()] ^= (char)(1 + rng() % 255);
+            if(d % 5 == 0)
+                damaged.resize(rng() % damaged.size());
+            stringstream damaged_in(damaged);
+            EliasFanoSequence broken;
+            if(broken.Load(damaged_in))
+            {
+                for(uint64_t i = 0; i < broken.Size(); i++)
+                    broken.Access(i);
+                uint64_t found = 0;
+                broken.LowerBound(rng() % universe, found);
+            }
+        }
+    }
+
+    if(failures > 0)
+    {
+        cerr << failures << " checks failed." << endl;
+        return 1;
+    }
+    cerr << "all checks passed." << endl;
+    return 0;
+}
@@ -0,0 +1,353 @@
+#ifndef ELIAS_FANO_SEQUENCE_H
+#define ELIAS_FANO_SEQUENCE_H
+
+#include <stdint.h>
+#include <vector>
+#include <iostream>
+
+namespace kaijiang_api
+{
+    // description: compressed monotone (non-decreasing) sequence of 64 bit values, Elias-Fano encoding.
+    //  each value is split into low_bits low bits, stored verbatim, and the remaining high bits,
+    //  stored in unary in a bit vector, so the sequence costs about 2 + log2(max_value / count) bits
+    //  per value. Access (select) and LowerBound (rank) use sampled select on the high bits.
+    // usage:
+    //  Init(count, max_value), then Append count values in order; or Build(values).
+    class EliasFanoSequence
+    {
+        private:
+            static const uint64_t kSampleRate = 512;
+
+            uint64_t count;
+            uint64_t appended;
+            uint64_t max_value;
+            uint32_t low_bits;
+            uint64_t high_bits_size;
+            uint64_t last_value;
+            std::vector<uint64_t> low_words;
+            std::vector<uint64_t> high_words;
+            std::vector<uint64_t> select1_samples;  // position of every kSampleRate-th one
+            std::vector<uint64_t> select0_samples;  // position of every kSampleRate-th zero
+
+        private:
+            // description: position of the k-th (from 0) set bit in a word
+            static inline uint64_t SelectInWord(uint64_t word, uint64_t k)
+            {
+                for(uint64_t i = 0; i < k; i++)
+                    word &= word - 1;
+                return __builtin_ctzll(word);
+            }
+
+            inline uint64_t GetLow(const uint64_t i) const
+            {
+                if(low_bits == 0)
+                    return 0;
+                uint64_t bit = i * low_bits;
+                uint64_t word_index = bit / 64;
+                uint32_t shift = bit % 64;
+                uint64_t value = low_words[word_index] >> shift;
+                if(shift + low_bits > 64)
+                    value |= low_words[word_index + 1] << (64 - shift);
+                return value & ((1ULL << low_bits) - 1);
+            }
+
+            void SetLow(const uint64_t i, const uint64_t value)
+            {
+                if(low_bits == 0)
+                    return;
+                uint64_t bit = i * low_bits;
+                uint64_t word_index = bit / 64;
+                uint32_t shift = bit % 64;
+                low_words[word_index] |= value << shift;
+                if(shift + low_bits > 64)
+                    low_words[word_index + 1] |= value >> (64 - shift);
+            }
+
+            // description: build select samples, called once all values are appended
+            void BuildSamples()
+            {
+                select1_samples.clear();
+                select0_samples.clear();
+                uint64_t ones = 0;
+                uint64_t zeros = 0;
+                for(uint64_t w = 0; w < high_words.size(); w++)
+                {
+                    uint64_t valid = 0;
+                    if(w * 64 < high_bits_size)
+                        valid = high_bits_size - w * 64 < 64 ? high_bits_size - w * 64 : 64;
+                    uint64_t word = high_words[w];
+                    uint64_t zero_word = ~word;
+                    if(valid < 64)
+                        zero_word &= (1ULL << valid) - 1;
+                    uint64_t word_ones = __builtin_popcountll(word);
+                    uint64_t word_zeros = __builtin_popcountll(zero_word);
+
+                    while(select1_samples.size() * kSampleRate < ones + word_ones)
+                        select1_samples.push_back(w * 64 + SelectInWord(word, select1_samples.size() * kSampleRate - ones));
+                    while(select0_samples.size() * kSampleRate < zeros + word_zeros)
+                        select0_samples.push_back(w * 64 + SelectInWord(zero_word, select0_samples.size() * kSampleRate - zeros));
+
+                    ones += word_ones;
+                    zeros += word_zeros;
+                }
+            }
+
+            // description: position of the k-th (from 0) one in the high bits
+            uint64_t Select1(const uint64_t k) const
+            {
+                uint64_t pos = select1_samples[k / kSampleRate];
+                uint64_t remain = k % kSampleRate;
+                uint64_t word_index = pos / 64;
+                uint64_t word = high_words[word_index] & (~0ULL << (pos % 64));
+                while(true)
+                {
+                    uint64_t ones = __builtin_popcountll(word);
+                    if(remain < ones)
+                        return word_index * 64 + SelectInWord(word, remain);
+                    remain -= ones;
+                    word = high_words[++word_index];
+                }
+            }
+
+            // description: position of the k-th (from 0) zero in the high bits
+            uint64_t Select0(const uint64_t k) const
+            {
+                uint64_t pos = select0_samples[k / kSampleRate];
+                uint64_t remain = k % kSampleRate;
+                uint64_t word_index = pos / 64;
+                uint64_t word = ~high_words[word_index] & (~0ULL << (pos % 64));
+                while(true)
+                {
+                    uint64_t zeros = __builtin_popcountll(word);
+                    if(remain < zeros)
+                        return word_index * 64 + SelectInWord(word, remain);
+                    remain -= zeros;
+                    word = ~high_words[++word_index];
+                }
+            }
+
+            template<typename T>
+                static bool WriteVector(std::ostream& out, const std::vector<T>& v)
+                {
+                    uint64_t size = v.size();
+                    out.write((const char*)(&size), sizeof(size));
+                    if(size > 0)
+                        out.write((const char*)(&v[0]), sizeof(T) * size);
+                    return out.good();
+                }
+
+            // description: read a vector written by WriteVector, its size must be the expected one.
+            //  it grows chunk by chunk, so a damaged file can not make it allocate more than it holds
+            template<typename T>
+                static bool ReadVector(std::istream& in, std::vector<T>& v, const uint64_t expected_size)
+                {
+                    uint64_t size = 0;
+                    if(!in.read((char*)(&size), sizeof(size)) || size != expected_size)
+                        return false;
+                    v.clear();
+                    const uint64_t kChunk = 1 << 20;
+                    while(v.size() < size)
+                    {
+                        uint64_t done = v.size();
+                        uint64_t n = size - done < kChunk ? size - done : kChunk;
+                        v.resize(done + n);
+                        if(!in.read((char*)(&v[done]), sizeof(T) * n))
+                            return false;
+                    }
+                    return true;
+                }
+
+            // description: compute the layout of a sequence
+            // parameters:
+            //  [IN] the_count -- number of values
+            //  [IN] the_max_value -- the largest value
+            //  [OUT] the_low_bits -- low bits per value
+            //  [OUT] the_high_bits_size -- bits of the high part
+            // return:
+            //  false if the sequence is too large to be addressed
+            static bool Layout(const uint64_t the_count, const uint64_t the_max_value, uint32_t& the_low_bits, uint64_t& the_high_bits_size)
+            {
+                the_low_bits = 0;
+                the_high_bits_size = 0;
+                if(the_count == 0)
+                    return true;
+                uint64_t ratio = the_max_value / the_count;
+                while(ratio > 1)
+                {
+                    ratio >>= 1;
+                    the_low_bits++;
+                }
+                if(the_count > (1ULL << 56) / 64 || (the_max_value >> the_low_bits) > (1ULL << 56))
+                    return false;
+                the_high_bits_size = the_count + (the_max_value >> the_low_bits) + 1;
+                return true;
+            }
+
+        public:
+            EliasFanoSequence()
+            {
+                Init(0, 0);
+            }
+
+            // description: prepare an empty sequence
+            // parameters:
+            //  [IN] the_count -- number of values that will be appended
+            //  [IN] the_max_value -- the largest (last) value
+            // return:
+            //  nothing
+            void Init(const uint64_t the_count, const uint64_t the_max_value)
+            {
+                count = the_count;
+                appended = 0;
+                max_value = the_max_value;
+                last_value = 0;
+                Layout(count, max_value, low_bits, high_bits_size);
+                low_words.assign((count * low_bits + 63) / 64 + 1, 0);
+                high_words.assign((high_bits_size + 63) / 64 + 1, 0);
+                select1_samples.clear();
+                select0_samples.clear();
+                if(count == 0)
+                    BuildSamples();
+            }
+
+            // description: append the next value
+            // parameters:
+            //  [IN] value -- not less than the previous value, not greater than max_value
+            // return:
+            //  true -- success
+            bool Append(const uint64_t value)
+            {
+                if(appended >= count || value > max_value || value < last_value)
+                    return false;
+
+                SetLow(appended, value & (low_bits ? (1ULL << low_bits) - 1 : 0));
+                uint64_t pos = (value >> low_bits) + appended;
+                high_words[pos / 64] |= 1ULL << (pos % 64);
+                last_value = value;
+                appended++;
+                if(appended == count)
+                    BuildSamples();
+                return true;
+            }
+
+            // description: build from a non-decreasing value list
+            bool Build(const std::vector<uint64_t>& values)
+            {
+                Init(values.size(), values.empty() ? 0 : values.back());
+                for(size_t i = 0; i < values.size(); i++)
+                {
+                    if(!Append(values[i]))
+                        return false;
+                }
+                return true;
+            }
+
+            // description: get the number of values
+            inline uint64_t Size() const {return count;}
+
+            // description: get the heap bytes used by the sequence
+            inline size_t MemoryBytes() const
+            {
+                return sizeof(uint64_t) * (low_words.size() + high_words.size() + select1_samples.size() + select0_samples.size());
+            }
+
+            // description: get the i-th value, i must be less than Size()
+            uint64_t Access(const uint64_t i) const
+            {
+                return ((Select1(i) - i) << low_bits) | GetLow(i);
+            }
+
+            // description: find the first value not less than the given one
+            // parameters:
+            //  [IN] value -- the value
+            //  [OUT] found -- the value found
+            // return:
+            //  position of the value found, Size() if there is none
+            uint64_t LowerBound(const uint64_t value, uint64_t& found) const
+            {
+                if(count == 0 || value > max_value)
+                    return count;
+
+                uint64_t high = value >> low_bits;
+                uint64_t pos = 0;
+                uint64_t i = 0;
+                if(high > 0)
+                {
+                    pos = Select0(high - 1) + 1;
+                    i = pos - high;
+                }
+
+                uint64_t word_index = pos / 64;
+                uint64_t word = high_words[word_index] & (~0ULL << (pos % 64));
+                for(; i < count; i++)
+                {
+                    while(word == 0)
+                        word = high_words[++word_index];
+                    uint64_t one = word_index * 64 + __builtin_ctzll(word);
+                    word &= word - 1;
+                    uint64_t v = ((one - i) << low_bits) | GetLow(i);
+                    if(v >= value)
+                    {
+                        found = v;
+                        return i;
+                    }
+                }
+                return count;
+            }
+
+            bool Save(std::ostream& out) const
+            {
+                out.write((const char*)(&count), sizeof(count));
+                out.write((const char*)(&max_value), sizeof(max_value));
+                out.write((const char*)(&low_bits), sizeof(low_bits));
+                return WriteVector(out, low_words) && WriteVector(out, high_words);
+            }
+
+            // description: load a sequence written by Save, the layout and the high bits are checked
+            //  so that a damaged stream is rejected instead of making select read out of range
+            bool Load(std::istream& in)
+            {
+                uint64_t the_count = 0;
+                uint64_t the_max_value = 0;
+                uint32_t the_low_bits = 0;
+                in.read((char*)(&the_count), sizeof(the_count));
+                in.read((char*)(&the_max_value), sizeof(the_max_value));
+                in.read((char*)(&the_low_bits), sizeof(the_low_bits));
+                uint32_t expected_low_bits = 0;
+                uint64_t expected_high_bits_size = 0;
+                if(!in || !Layout(the_count, the_max_value, expected_low_bits, expected_high_bits_size) || the_low_bits != expected_low_bits)
+                    return false;
+
+                std::vector<uint64_t> the_low_words, the_high_words;
+                if(!ReadVector(in, the_low_words, (the_count * the_low_bits + 63) / 64 + 1)
+                        || !ReadVector(in, the_high_words, (expected_high_bits_size + 63) / 64 + 1))
+                    return false;
+
+                // exactly count ones and (max_value >> low_bits) + 1 zeros within the high bits
+                uint64_t ones = 0;
+                for(size_t w = 0; w < the_high_words.size(); w++)
+                {
+                    uint64_t word = the_high_words[w];
+                    if(w * 64 + 64 > expected_high_bits_size)
+                    {
+                        uint64_t valid = w * 64 < expected_high_bits_size ? expected_high_bits_size - w * 64 : 0;
+                        if(valid < 64 && (word >> valid) != 0)
+                            return false;
+                    }
+                    ones += __builtin_popcountll(word);
+                }
+                if(ones != the_count || expected_high_bits_size - ones != (the_count > 0 ? (the_max_value >> the_low_bits) + 1 : 0))
+                    return false;
+
+                Init(the_count, the_max_value);
+                low_words.swap(the_low_words);
+                high_words.swap(the_high_words);
+                appended = count;
+                last_value = max_value;
+                BuildSamples();
+                return true;
+            }
+    };
+};
+
+#endif
@@ -0,0 +1,428 @@
+#ifndef SEGMENTED_DATA_WRITER_H
+#define SEGMENTED_DATA_WRITER_H
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <queue>
+#include <algorithm>
+#include <utility>
+#include <mutex>
+#include <iostream>
+#include <fstream>
+#include "virtual_memory_data.hpp"
+
+namespace kaijiang_api
+{
+    // description: append the whole input file to the output file, with copy_file_range so the
+    //  kernel can share or clone extents instead of copying through user space, falling back to
+    //  read/write where it is not supported
+    // parameters:
+    //  [IN] in_file -- the input file
+    //  [IN] out_fd -- the output file, positioned at its end, not opened with O_APPEND
+    // return:
+    //  bytes appended, -1 if failed
+    inline int64_t AppendFile(const std::string& in_file, int out_fd)
+    {
+        int in_fd = open(in_file.c_str(), O_RDONLY);
+        if(in_fd < 0)
+        {
+            cerr<<in_file<<" can not be opened."<<endl;
+            return -1;
+        }
+
+        int64_t total = 0;
+        bool use_copy_file_range = true;
+        std::vector<char> buffer;
+        while(true)
+        {
+            ssize_t n = -1;
+            if(use_copy_file_range)
+            {
+                n = copy_file_range(in_fd, NULL, out_fd, NULL, 1 << 30, 0);
+                if(n < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP))
+                {
+                    use_copy_file_range = false;
+                    continue;
+                }
+            }
+            else
+            {
+                if(buffer.empty())
+                    buffer.resize(1 << 20);
+                n = read(in_fd, &buffer[0], buffer.size());
+                for(ssize_t written = 0; n > 0 && written < n; )
+                {
+                    ssize_t w = write(out_fd, &buffer[written], n - written);
+                    if(w < 0)
+                    {
+                        n = -1;
+                        break;
+                    }
+                    written += w;
+                }
+            }
+
+            if(n < 0)
+            {
+                if(errno == EINTR)
+                    continue;
+                cerr<<in_file<<" can not be appended."<<endl;
+                close(in_fd);
+                return -1;
+            }
+            if(n == 0)
+                break;
+            total += n;
+        }
+        close(in_fd);
+        return total;
+    }
+
+    // description: cursor of an index run, used to merge the runs
+    typedef struct
+    {
+        uint64_t id;
+        uint32_t run;
+    }IndexRunCursor;
+
+    struct CmpIndexRunCursor
+    {
+        bool operator()(const IndexRunCursor& cursor1, const IndexRunCursor& cursor2) const
+        {
+            return cursor1.id > cursor2.id;
+        }
+    };
+
+    // description: writer building one database from several threads. each thread takes its
+    //  own segment, a plain VirtualMemoryDataWriter on <name>.segment<N>, and writes a disjoint
+    //  set of ids to it in increasing order. Finalize appends the segment blocks, in order of
+    //  their first id, into <name>.block and merges the sorted index runs into <name>.index,
+    //  rebasing the offsets.
+    // usage:
+    //  Open(file); CreateSegment() once per thread; write from the threads; join; Finalize().
+    template<typename BlockData>
+        class VirtualMemoryDataSegmentedWriter
+        {
+            private:
+                std::string file_name;
+                bool build_succinct_index;
+                std::vector<VirtualMemoryDataWriter<BlockData>*> segments;
+                std::mutex segments_mutex;
+
+            private:
+                VirtualMemoryDataSegmentedWriter(const VirtualMemoryDataSegmentedWriter&);
+                VirtualMemoryDataSegmentedWriter& operator=(const VirtualMemoryDataSegmentedWriter&);
+
+                std::string SegmentName(const size_t segment) const
+                {
+                    return file_name + ".segment" + std::to_string(segment);
+                }
+
+                // description: close and delete segment writers, and their files if asked
+                void Clean(bool remove_files)
+                {
+                    for(size_t i = 0; i < segments.size(); i++)
+                    {
+                        delete segments[i];
+                        if(remove_files)
+                        {
+                            remove((SegmentName(i) + ".block").c_str());
+                            remove((SegmentName(i) + ".index").c_str());
+                        }
+                    }
+                    segments.clear();
+                }
+
+                // description: order the segments by the first id of their index runs, empty runs
+                //  last, so that segments holding increasing disjoint id ranges give back to back lists
+                //  whatever order CreateSegment was called in
+                // parameters:
+                //  [OUT] order -- segment numbers in merge order
+                // return:
+                //  true -- success
+                bool OrderSegments(std::vector<size_t>& order) const
+                {
+                    std::vector<std::pair<std::pair<bool, uint64_t>, size_t> > first_ids;
+                    for(size_t i = 0; i < segments.size(); i++)
+                    {
+                        std::ifstream index_fin((SegmentName(i) + ".index").c_str(), ios::binary);
+                        if(!index_fin.is_open())
+                        {
+                            cerr<<SegmentName(i)<<".index can not be opened."<<endl;
+                            return false;
+                        }
+                        VirtualMemoryDataIndex index;
+                        bool empty = !index_fin.read((char*)(&index), sizeof(VirtualMemoryDataIndex));
+                        first_ids.push_back(std::make_pair(std::make_pair(empty, empty ? 0 : index.id), i));
+                    }
+                    std::sort(first_ids.begin(), first_ids.end());
+                    order.clear();
+                    for(size_t i = 0; i < first_ids.size(); i++)
+                        order.push_back(first_ids[i].second);
+                    return true;
+                }
+
+                // description: append the block files of all segments into one file in the given
+                //  order, the first segment's block file is renamed to it, the others are appended.
+                //  on failure the first segment's block file is given back
+                // parameters:
+                //  [IN] order -- segment numbers in merge order
+                //  [IN] block_file_name -- the merged block file
+                //  [OUT] block_bases -- the first BlockData of each segment in the merged block file
+                //  [OUT] first_block_bytes -- bytes of the first segment's block file, to give it back
+                // return:
+                //  true -- success
+                bool MergeBlock(const std::vector<size_t>& order, const std::string& block_file_name, std::vector<uint64_t>& block_bases, uint64_t& first_block_bytes)
+                {
+                    block_bases.assign(segments.size(), 0);
+                    if(rename((SegmentName(order[0]) + ".block").c_str(), block_file_name.c_str()) != 0)
+                    {
+                        cerr<<SegmentName(order[0])<<".block can not be renamed."<<endl;
+                        return false;
+                    }
+
+                    int out_fd = open(block_file_name.c_str(), O_WRONLY);
+                    if(out_fd < 0)
+                    {
+                        cerr<<block_file_name<<" can not be opened."<<endl;
+                        RestoreBlock(order[0], block_file_name, 0);
+                        return false;
+                    }
+                    uint64_t block_bytes = lseek(out_fd, 0, SEEK_END);
+                    first_block_bytes = block_bytes;
+                    for(size_t i = 1; i < order.size(); i++)
+                    {
+                        block_bases[order[i]] = block_bytes / sizeof(BlockData);
+                        int64_t appended = AppendFile(SegmentName(order[i]) + ".block", out_fd);
+                        if(appended < 0)
+                        {
+                            close(out_fd);
+                            RestoreBlock(order[0], block_file_name, first_block_bytes);
+                            return false;
+                        }
+                        block_bytes += appended;
+                    }
+                    if(close(out_fd) != 0)
+                    {
+                        RestoreBlock(order[0], block_file_name, first_block_bytes);
+                        return false;
+                    }
+                    return true;
+                }
+
+                // description: give the merged block file back to its first segment, cutting what was appended
+                // parameters:
+                //  [IN] segment -- the first segment in merge order
+                //  [IN] block_file_name -- the merged block file
+                //  [IN] first_block_bytes -- bytes of the segment's block file
+                // return:
+                //  nothing
+                void RestoreBlock(const size_t segment, const std::string& block_file_name, const uint64_t first_block_bytes)
+                {
+                    if(truncate(block_file_name.c_str(), first_block_bytes) != 0
+                            || rename(block_file_name.c_str(), (SegmentName(segment) + ".block").c_str()) != 0)
+                        cerr<<SegmentName(segment)<<".block can not be restored."<<endl;
+                }
+
+                // description: rename the merged files into place. .index goes first, a hard link
+                //  keeps the old one so it is put back if .block can not be renamed
+                // parameters:
+                //  [IN] block_tmp_name -- the merged block file
+                //  [IN] index_tmp_name -- the merged index file
+                // return:
+                //  true -- success, false if the old database is still in place
+                bool Install(const std::string& block_tmp_name, const std::string& index_tmp_name)
+                {
+                    std::string index_file_name = file_name + ".index";
+                    std::string backup_name = index_file_name + ".old";
+                    remove(backup_name.c_str());
+                    bool has_backup = link(index_file_name.c_str(), backup_name.c_str()) == 0;
+                    if(rename(index_tmp_name.c_str(), index_file_name.c_str()) != 0)
+                    {
+                        if(has_backup)
+                            remove(backup_name.c_str());
+                        return false;
+                    }
+                    if(rename(block_tmp_name.c_str(), (file_name + ".block").c_str()) != 0)
+                    {
+                        if(has_backup)
+                            rename(backup_name.c_str(), index_file_name.c_str());
+                        else
+                            remove(index_file_name.c_str());
+                        return false;
+                    }
+                    if(has_backup)
+                        remove(backup_name.c_str());
+                    return true;
+                }
+
+                // description: merge the index runs of all segments into one index file. the runs
+                //  are streamed, one pending record per run, so the index is never held in memory;
+                //  each run must be in increasing id order, as written by its segment
+                // parameters:
+                //  [IN] index_file_name -- the merged index file
+                //  [IN] block_bases -- the first BlockData of each segment in the merged block file
+                // return:
+                //  true -- success
+                bool MergeIndex(const std::string& index_file_name, const std::vector<uint64_t>& block_bases)
+                {
+                    std::vector<std::ifstream> runs(segments.size());
+                    std::vector<VirtualMemoryDataIndex> pending(segments.size());
+                    std::priority_queue<IndexRunCursor, std::vector<IndexRunCursor>, CmpIndexRunCursor> heap;
+                    for(uint32_t i = 0; i < runs.size(); i++)
+                    {
+                        runs[i].open((SegmentName(i) + ".index").c_str(), ios::binary);
+                        if(!runs[i].is_open())
+                        {
+                            cerr<<SegmentName(i)<<".index can not be opened."<<endl;
+                            return false;
+                        }
+                        if(runs[i].read((char*)(&pending[i]), sizeof(VirtualMemoryDataIndex)))
+                        {
+                            IndexRunCursor cursor = {pending[i].id, i};
+                            heap.push(cursor);
+                        }
+                    }
+
+                    std::ofstream index_fout(index_file_name.c_str(), ios::binary);
+                    if(!index_fout.is_open())
+                    {
+                        cerr<<index_file_name<<" can not be opened."<<endl;
+                        return false;
+                    }
+
+                    uint64_t last_id = 0;
+                    bool has_last = false;
+                    while(!heap.empty())
+                    {
+                        IndexRunCursor cursor = heap.top();
+                        heap.pop();
+                        VirtualMemoryDataIndex index = pending[cursor.run];
+                        if(has_last && index.id == last_id)
+                        {
+                            cerr<<"id "<<index.id<<" is written by more than one segment."<<endl;
+                            return false;
+                        }
+                        last_id = index.id;
+                        has_last = true;
+                        index.off += block_bases[cursor.run];
+                        index_fout.write((const char*)(&index), sizeof(VirtualMemoryDataIndex));
+
+                        if(runs[cursor.run].read((char*)(&pending[cursor.run]), sizeof(VirtualMemoryDataIndex)))
+                        {
+                            if(pending[cursor.run].id <= last_id)
+                            {
+                                cerr<<SegmentName(cursor.run)<<" is not written in increasing id order."<<endl;
+                                return false;
+                            }
+                            cursor.id = pending[cursor.run].id;
+                            heap.push(cursor);
+                        }
+                    }
+                    index_fout.close();
+                    return !index_fout.fail();
+                }
+
+            public:
+                VirtualMemoryDataSegmentedWriter()
+                {
+                    build_succinct_index = false;
+                }
+
+                virtual ~VirtualMemoryDataSegmentedWriter()
+                {
+                    Clean(true);
+                }
+
+                // description: open the database for writing
+                // parameters:
+                //  [IN] file -- the database name
+                //  [IN] succinct -- also build <name>.sindex in Finalize, the segments must hold
+                //   disjoint id ranges (not interleaved); segments are merged in order of their first id
+                // return:
+                //  true -- success
+                bool Open(const char* file, bool succinct = false)
+                {
+                    std::lock_guard<std::mutex> lock(segments_mutex);
+                    Clean(true);
+                    file_name = file;
+                    ConstructVirtualMemoryDataFileName(file_name);
+                    build_succinct_index = succinct;
+                    return true;
+                }
+
+                // description: create a segment writer, may be called from any thread. the writer
+                //  is owned by this object and must be driven by one thread at a time
+                // return:
+                //  the segment writer, NULL if failed
+                VirtualMemoryDataWriter<BlockData>* CreateSegment()
+                {
+                    std::lock_guard<std::mutex> lock(segments_mutex);
+                    if(file_name.empty())
+                        return NULL;
+
+                    VirtualMemoryDataWriter<BlockData>* segment = new VirtualMemoryDataWriter<BlockData>();
+                    if(!segment->Open(SegmentName(segments.size()).c_str()))
+                    {
+                        delete segment;
+                        return NULL;
+                    }
+                    segments.push_back(segment);
+                    return segment;
+                }
+
+                // description: close every segment and build <name>.block/<name>.index from them,
+                //  segment writers must not be used any more. both files are built under a .tmp
+                //  name and renamed into place only once the merge succeeded. a failed Finalize
+                //  leaves an earlier database, its .sindex and the segments untouched, so it may be
+                //  retried; a successful one can be called once per Open
+                // return:
+                //  true -- success, false also if the succinct index was asked for but not built
+                //   or if there is nothing to finalize
+                bool Finalize()
+                {
+                    std::lock_guard<std::mutex> lock(segments_mutex);
+                    // nothing to finalize: not opened, already finalized, or no segment created
+                    if(file_name.empty() || segments.empty())
+                        return false;
+
+                    for(size_t i = 0; i < segments.size(); i++)
+                        segments[i]->Close();
+
+                    std::string block_tmp_name = file_name + ".block.tmp";
+                    std::string index_tmp_name = file_name + ".index.tmp";
+                    std::vector<size_t> order;
+                    std::vector<uint64_t> block_bases;
+                    uint64_t first_block_bytes = 0;
+                    if(!OrderSegments(order) || !MergeBlock(order, block_tmp_name, block_bases, first_block_bytes))
+                    {
+                        cerr<<file_name<<" can not be finalized, segments are kept."<<endl;
+                        return false;
+                    }
+                    if(!MergeIndex(index_tmp_name, block_bases) || !Install(block_tmp_name, index_tmp_name))
+                    {
+                        cerr<<file_name<<" can not be finalized, segments are kept."<<endl;
+                        RestoreBlock(order[0], block_tmp_name, first_block_bytes);
+                        remove(index_tmp_name.c_str());
+                        return false;
+                    }
+
+                    // a succinct index of the old content must not outlive it
+                    remove((file_name + ".sindex").c_str());
+                    Clean(true);
+                    // the writer is done, a further Finalize must not merge zero segments over the database
+                    std::string finalized_name = file_name;
+                    file_name.clear();
+                    if(build_succinct_index)
+                        return BuildSuccinctIndexFile(finalized_name.c_str());
+                    return true;
+                }
+        };
+};
+
+#endif
@@ -0,0 +1,314 @@
+#ifndef VARIABLE_LENGTH_DATA_H
+#define VARIABLE_LENGTH_DATA_H
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <string>
+#include <type_traits>
+#include "virtual_memory_data.hpp"
+
+namespace kaijiang_api
+{
+    // description: read only view of a blob, like string_view, it points into the mapping
+    struct BlobView
+    {
+        const char* data;
+        uint32_t size;
+
+        BlobView() : data(NULL), size(0) {}
+        BlobView(const char* the_data, const uint32_t the_size) : data(the_data), size(the_size) {}
+        BlobView(const std::string& str) : data(str.data()), size(str.size()) {}
+
+        inline std::string ToString() const {return std::string(data, size);}
+    };
+
+    // description: on disk record of the variable length mode
+    // member:
+    //  fixed -- the fixed size fields, a POD
+    //  blob_off -- offset of each blob, relative to the start of the id's list
+    //  blob_size -- bytes of each blob
+    // Fixed must be a POD needing no more than 8 bytes alignment, lists start at 8 bytes boundaries
+    template<typename Fixed, uint32_t BlobNum>
+        struct VariableLengthRecord
+        {
+            static_assert(std::is_trivially_copyable<Fixed>::value && alignof(Fixed) <= 8,
+                    "Fixed must be trivially copyable and need no more than 8 bytes alignment");
+
+            Fixed fixed;
+            uint32_t blob_off[BlobNum > 0 ? BlobNum : 1];
+            uint32_t blob_size[BlobNum > 0 ? BlobNum : 1];
+        };
+
+    // description: header of each id's list, followed by the records and then the blob heap:
+    //  [header][record 0 .. record count-1][blob bytes][padding to 8 bytes]
+    typedef struct
+    {
+        uint32_t count;     // record number
+        uint32_t reserved;
+    }VariableLengthListHeader;
+
+    // description: zero copy access to one record and its blobs
+    template<typename Fixed, uint32_t BlobNum>
+        class VariableLengthRecordView
+        {
+            private:
+                const VariableLengthRecord<Fixed, BlobNum>* record;
+                const char* list;
+                uint32_t list_size;
+            public:
+                VariableLengthRecordView() : record(NULL), list(NULL), list_size(0) {}
+                VariableLengthRecordView(const VariableLengthRecord<Fixed, BlobNum>* the_record, const char* the_list, const uint32_t the_list_size)
+                    : record(the_record), list(the_list), list_size(the_list_size) {}
+
+                inline const Fixed& GetFixed() const {return record->fixed;}
+
+                // description: get the index-th blob, empty if it is out of range
+                BlobView GetBlob(const uint32_t index) const
+                {
+                    if(index >= BlobNum)
+                        return BlobView();
+                    uint32_t off = record->blob_off[index];
+                    uint32_t size = record->blob_size[index];
+                    if(off > list_size || size > list_size - off)
+                        return BlobView();
+                    return BlobView(list + off, size);
+                }
+        };
+
+    // description: reader of the variable length mode, each id maps to a list of records
+    //  with fixed fields plus blobs stored out of line in the same mapping
+    template<typename Fixed, uint32_t BlobNum>
+        class VariableLengthData
+        {
+            public:
+                typedef VariableLengthRecord<Fixed, BlobNum> Record;
+                typedef VariableLengthRecordView<Fixed, BlobNum> RecordView;
+
+                // description: handle each record when scanning the list
+                // parameters:
+                //  [IN] record -- each record
+                //  [IN] sequence_num -- current sequence
+                //  [IN/OUT] resource -- self-defined resource
+                // return:
+                //  true -- success
+                typedef bool (*HandleRecord)(const RecordView& record, const uint32_t sequence_num, void* resource);
+
+            private:
+                VirtualMemoryData<char> data;
+
+            private:
+                // description: get the list of an id and check its header
+                // parameters:
+                //  [IN] id -- the id
+                //  [OUT] list_size -- bytes of the list
+                //  [OUT] count -- record number
+                // return:
+                //  the list, NULL if not found or broken
+                const char* GetList(const uint64_t id, uint32_t& list_size, uint32_t& count) const
+                {
+                    count = 0;
+                    const char* list = data.GetList(id, list_size);
+                    if(list == NULL || list_size < sizeof(VariableLengthListHeader))
+                        return NULL;
+
+                    const VariableLengthListHeader* header = (const VariableLengthListHeader*)list;
+                    if(header->count > (list_size - sizeof(VariableLengthListHeader)) / sizeof(Record))
+                    {
+#ifdef DEBUG
+                        cerr<<"broken variable length list, id="<<id<<endl;
+#endif
+                        return NULL;
+                    }
+                    count = header->count;
+                    return list;
+                }
+
+            public:
+                VariableLengthData()
+                {
+                }
+
+                // description: open the database
+                // parameters:
+                //  [IN] file -- the database name
+                //  [IN] succinct -- see VirtualMemoryData
+                VariableLengthData(const char* file, bool succinct = false) : data(file, succinct)
+                {
+                }
+
+                virtual ~VariableLengthData()
+                {
+                }
+
+                // description: get indexes' size
+                inline uint32_t IndexSize() const {return data.IndexSize();}
+
+                // description: get record number of an id, 0 if not found
+                uint32_t Size(const uint64_t id) const
+                {
+                    uint32_t list_size = 0;
+                    uint32_t count = 0;
+                    GetList(id, list_size, count);
+                    return count;
+                }
+
+                // description: get specified record in specified id's list
+                // parameters:
+                //  [IN] id -- the id
+                //  [IN] index -- the index
+                //  [OUT] record -- the record view
+                // return:
+                //  true -- if exists
+                bool GetRecord(const uint64_t id, const uint32_t index, RecordView& record) const
+                {
+                    uint32_t list_size = 0;
+                    uint32_t count = 0;
+                    const char* list = GetList(id, list_size, count);
+                    if(list == NULL || index >= count)
+                        return false;
+
+                    const Record* records = (const Record*)(list + sizeof(VariableLengthListHeader));
+                    record = RecordView(records + index, list, list_size);
+                    return true;
+                }
+
+                // description: scan the record list
+                // parameters:
+                //  [IN] id -- the id that indexes the record list
+                //  [IN] handler -- the handler that handle each record
+                //  [IN/OUT] resource -- self-defined resource
+                // return:
+                //  number of records that handled successfully
+                uint32_t Scan(const uint64_t id, HandleRecord handler, void* resource) const
+                {
+                    if(handler == NULL)
+                        return 0;
+
+                    uint32_t list_size = 0;
+                    uint32_t count = 0;
+                    const char* list = GetList(id, list_size, count);
+                    if(list == NULL)
+                        return 0;
+
+                    const Record* records = (const Record*)(list + sizeof(VariableLengthListHeader));
+                    uint32_t handled = 0;
+                    for(uint32_t index = 0; index < count; index++)
+                    {
+                        if(handler(RecordView(records + index, list, list_size), index, resource))
+                            handled++;
+                    }
+                    return handled;
+                }
+        };
+
+    // description: writer of the variable length mode. records of the current id are buffered and
+    //  written as one list, the blobs packed right after the records, so a list reads from one or
+    //  two pages.
+    template<typename Fixed, uint32_t BlobNum>
+        class VariableLengthDataWriter
+        {
+            public:
+                typedef VariableLengthRecord<Fixed, BlobNum> Record;
+
+            private:
+                VirtualMemoryDataWriter<char> writer;
+                std::vector<Record> records;
+                std::string blobs;
+                std::string list;
+                bool index_switched;
+
+            private:
+                void FlushList()
+                {
+                    if(!index_switched)
+                        return;
+
+                    VariableLengthListHeader header;
+                    header.count = records.size();
+                    header.reserved = 0;
+                    uint32_t heap_off = sizeof(VariableLengthListHeader) + sizeof(Record) * records.size();
+                    for(size_t i = 0; i < records.size(); i++)
+                    {
+                        for(uint32_t b = 0; b < BlobNum; b++)
+                            records[i].blob_off[b] += heap_off;
+                    }
+
+                    list.assign((const char*)(&header), sizeof(header));
+                    if(!records.empty())
+                        list.append((const char*)(&records[0]), sizeof(Record) * records.size());
+                    list.append(blobs);
+                    // keep every list 8 bytes aligned
+                    list.append((8 - list.size() % 8) % 8, '\0');
+                    writer.Write(list.data(), list.size(), true);
+
+                    records.clear();
+                    blobs.clear();
+                    index_switched = false;
+                }
+
+            public:
+                VariableLengthDataWriter()
+                {
+                    index_switched = false;
+                }
+
+                virtual ~VariableLengthDataWriter()
+                {
+                    Close();
+                }
+
+                // description: open the database for writing
+                // parameters:
+                //  [IN] file -- the database name
+                //  [IN] succinct -- see VirtualMemoryDataWriter
+                // return:
+                //  true -- success
+                bool Open(const char* file, bool succinct = false)
+                {
+                    Close();
+                    return writer.Open(file, succinct);
+                }
+
+                // description: flush the last list and close, see VirtualMemoryDataWriter::Close
+                bool Close()
+                {
+                    FlushList();
+                    return writer.Close();
+                }
+
+                bool SwitchIndex(const uint64_t id)
+                {
+                    FlushList();
+                    index_switched = writer.SwitchIndex(id);
+                    return index_switched;
+                }
+
+                // description: append a record to the current id's list
+                // parameters:
+                //  [IN] fixed -- the fixed fields
+                //  [IN] blob_list -- BlobNum blobs, copied into the list's blob heap
+                // return:
+                //  true -- success
+                bool Write(const Fixed& fixed, const BlobView* blob_list)
+                {
+                    if(!index_switched || (BlobNum > 0 && blob_list == NULL))
+                        return false;
+
+                    Record record;
+                    memset(&record, 0, sizeof(Record));
+                    record.fixed = fixed;
+                    for(uint32_t b = 0; b < BlobNum; b++)
+                    {
+                        record.blob_off[b] = blobs.size();
+                        record.blob_size[b] = blob_list[b].size;
+                        if(blob_list[b].size > 0)
+                            blobs.append(blob_list[b].data, blob_list[b].size);
+                    }
+                    records.push_back(record);
+                    return true;
+                }
+        };
+};
+
+#endif
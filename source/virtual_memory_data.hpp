@@ -10,11 +10,15 @@
 #include <stdint.h>
 #include <vector>
 #include "virtual_memory_mapper.hpp"
+#include "elias_fano_sequence.hpp"
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <algorithm>
 #include <set>
+#include <memory>
+#include <stdio.h>
+#include <sys/stat.h>
 #include <boost/algorithm/string.hpp>
 
 using namespace std;
@@ -26,6 +30,7 @@ namespace kaijiang_api
         boost::algorithm::trim(file); 
         std::string ex1 = ".block";
         std::string ex2 = ".index";
+        std::string ex3 = ".sindex";
 		size_t pos = file.rfind(ex1);
 		if(pos != file.npos && pos + ex1.size() == file.size())
 		{
@@ -38,6 +43,12 @@ namespace kaijiang_api
 			file = file.substr(0, pos);
 			return;
 		}
+		pos = file.rfind(ex3);
+		if(pos != file.npos && pos + ex3.size() == file.size())
+		{
+			file = file.substr(0, pos);
+			return;
+		}
 	}
 
 	// description: definition of data index
@@ -56,6 +67,278 @@ namespace kaijiang_api
 	{
 		return index1.id < index2.id;
 	}
+
+	// description: load the index file and sort it by id
+	// parameters:
+	//  [IN] file_name -- the database name, without extension
+	//  [OUT] sorted_index_list -- the index list
+	// return:
+	//  true -- success
+	inline bool LoadVirtualMemoryDataIndex(const std::string& file_name, std::vector<VirtualMemoryDataIndex>& sorted_index_list)
+	{
+		sorted_index_list.clear();
+		std::ifstream binar_index_file((file_name + ".index").c_str(), ios::binary);
+		if(!binar_index_file.is_open())
+		{
+			cerr<<file_name<<".index can not be opened."<<endl;
+			return false;
+		}
+
+		VirtualMemoryDataIndex index;
+		while(!binar_index_file.read((char*)(&index), sizeof(VirtualMemoryDataIndex)).eof())
+		{
+#ifdef DEBUG
+			cerr<<"id = "<<index.id<<", off = "<<index.off<<", size = "<<index.size<<endl;
+#endif
+			sorted_index_list.push_back(index);
+		}
+#ifdef DEBUG
+		cerr<<sorted_index_list.size()<<endl;
+#endif
+		// sort index by id
+		sort(sorted_index_list.begin(), sorted_index_list.end(), CmpMemoryIndexId);
+		binar_index_file.close();
+		return true;
+	}
+
+	// description: sizes and modification times of <name>.index and <name>.block, stored in
+	//  <name>.sindex so a succinct index left over from an earlier build is not trusted
+	typedef struct
+	{
+		uint64_t index_bytes;
+		uint64_t block_bytes;
+		int64_t index_mtime_ns;
+		int64_t block_mtime_ns;
+	}VirtualMemoryDataStamp;
+
+	// description: get the stamp of the database files
+	// parameters:
+	//  [IN] file_name -- the database name, without extension
+	//  [OUT] stamp -- the stamp
+	// return:
+	//  true -- success
+	inline bool GetVirtualMemoryDataStamp(const std::string& file_name, VirtualMemoryDataStamp& stamp)
+	{
+		struct stat index_st, block_st;
+		if(stat((file_name + ".index").c_str(), &index_st) != 0 || stat((file_name + ".block").c_str(), &block_st) != 0)
+			return false;
+		stamp.index_bytes = index_st.st_size;
+		stamp.block_bytes = block_st.st_size;
+		stamp.index_mtime_ns = (int64_t)index_st.st_mtim.tv_sec * 1000000000LL + index_st.st_mtim.tv_nsec;
+		stamp.block_mtime_ns = (int64_t)block_st.st_mtim.tv_sec * 1000000000LL + block_st.st_mtim.tv_nsec;
+		return true;
+	}
+
+	// description: compact replacement of the sorted VirtualMemoryDataIndex list.
+	//  ids are kept in one Elias-Fano sequence and list boundaries in another one, the i-th
+	//  boundary being the offset of the i-th id's list, so off and size are implicit.
+	//  it needs lists written back to back in increasing id order, which is what
+	//  VirtualMemoryDataWriter produces when SwitchIndex is called with increasing ids.
+	//  it is saved next to the database as <name>.sindex.
+	class SuccinctDataIndex
+	{
+		private:
+			static const uint64_t kMagic = 0x5844494e49435553ULL; // "SUCINIDX"
+			EliasFanoSequence ids;
+			EliasFanoSequence bounds;
+		public:
+			// description: build from the id sorted index list
+			// parameters:
+			//  [IN] sorted_index_list -- the index list, sorted by id
+			// return:
+			//  true -- success, false if ids repeat or lists are not back to back
+			bool Build(const std::vector<VirtualMemoryDataIndex>& sorted_index_list)
+			{
+				uint64_t count = sorted_index_list.size();
+				if(count == 0)
+				{
+					ids.Init(0, 0);
+					bounds.Init(0, 0);
+					return true;
+				}
+
+				for(uint64_t i = 1; i < count; i++)
+				{
+					const VirtualMemoryDataIndex& prev = sorted_index_list[i - 1];
+					if(prev.id == sorted_index_list[i].id || prev.off + prev.size != sorted_index_list[i].off)
+					{
+#ifdef DEBUG
+						cerr<<"index is not contiguous at id="<<sorted_index_list[i].id<<endl;
+#endif
+						return false;
+					}
+				}
+
+				const VirtualMemoryDataIndex& last = sorted_index_list.back();
+				ids.Init(count, last.id);
+				bounds.Init(count + 1, last.off + last.size);
+				for(uint64_t i = 0; i < count; i++)
+				{
+					ids.Append(sorted_index_list[i].id);
+					bounds.Append(sorted_index_list[i].off);
+				}
+				bounds.Append(last.off + last.size);
+				return true;
+			}
+
+			// description: build from <name>.index read in file order, in two passes so the
+			//  VirtualMemoryDataIndex list is never held in memory
+			// parameters:
+			//  [IN] file_name -- the database name, without extension
+			// return:
+			//  true -- success, false if ids do not increase or lists are not back to back
+			bool Build(const std::string& file_name)
+			{
+				std::ifstream fin((file_name + ".index").c_str(), ios::binary);
+				if(!fin.is_open())
+				{
+					cerr<<file_name<<".index can not be opened."<<endl;
+					return false;
+				}
+
+				// first pass: check the order and get count and maximums
+				uint64_t count = 0;
+				VirtualMemoryDataIndex index, last;
+				while(fin.read((char*)(&index), sizeof(VirtualMemoryDataIndex)))
+				{
+					if(count > 0 && (index.id <= last.id || last.off + last.size != index.off))
+					{
+#ifdef DEBUG
+						cerr<<"index is not contiguous at id="<<index.id<<endl;
+#endif
+						return false;
+					}
+					last = index;
+					count++;
+				}
+				if(count == 0)
+				{
+					ids.Init(0, 0);
+					bounds.Init(0, 0);
+					return true;
+				}
+
+				// second pass: append
+				fin.clear();
+				fin.seekg(0, ios::beg);
+				ids.Init(count, last.id);
+				bounds.Init(count + 1, last.off + last.size);
+				for(uint64_t i = 0; i < count; i++)
+				{
+					if(!fin.read((char*)(&index), sizeof(VirtualMemoryDataIndex)) || !ids.Append(index.id) || !bounds.Append(index.off))
+					{
+						ids.Init(0, 0);
+						bounds.Init(0, 0);
+						return false;
+					}
+				}
+				bounds.Append(last.off + last.size);
+				return true;
+			}
+
+			// description: get data location
+			// parameters:
+			//  [IN] id -- the id
+			//  [OUT] off -- the offset in the block list
+			//  [OUT] size -- the block data size
+			// return:
+			//  true -- success
+			bool Find(const uint64_t id, uint64_t& off, uint32_t& size) const
+			{
+				uint64_t found = 0;
+				uint64_t pos = ids.LowerBound(id, found);
+				if(pos == ids.Size() || found != id)
+					return false;
+
+				off = bounds.Access(pos);
+				uint64_t end = bounds.Access(pos + 1);
+				if(end < off || end - off > 0xffffffffULL)
+					return false;
+				size = end - off;
+				return true;
+			}
+
+			// description: get the number of ids
+			inline uint64_t Size() const {return ids.Size();}
+
+			// description: get the heap bytes used by the index
+			inline size_t MemoryBytes() const {return ids.MemoryBytes() + bounds.MemoryBytes();}
+
+			// description: save to <name>.sindex, stamped with the current .index and .block
+			// parameters:
+			//  [IN] file_name -- the database name, without extension
+			// return:
+			//  true -- success
+			bool Save(const std::string& file_name) const
+			{
+				VirtualMemoryDataStamp stamp;
+				if(!GetVirtualMemoryDataStamp(file_name, stamp))
+					return false;
+				std::ofstream fout((file_name + ".sindex").c_str(), ios::binary);
+				if(!fout.is_open())
+					return false;
+				uint64_t magic = kMagic;
+				fout.write((const char*)(&magic), sizeof(magic));
+				fout.write((const char*)(&stamp), sizeof(stamp));
+				return ids.Save(fout) && bounds.Save(fout);
+			}
+
+			// description: load <name>.sindex, rejected if its stamp does not match .index and .block
+			// parameters:
+			//  [IN] file_name -- the database name, without extension
+			// return:
+			//  true -- success
+			bool Load(const std::string& file_name)
+			{
+				std::ifstream fin((file_name + ".sindex").c_str(), ios::binary);
+				if(!fin.is_open())
+					return false;
+				uint64_t magic = 0;
+				if(!fin.read((char*)(&magic), sizeof(magic)) || magic != kMagic)
+					return false;
+				VirtualMemoryDataStamp stamp, current;
+				if(!fin.read((char*)(&stamp), sizeof(stamp)) || !GetVirtualMemoryDataStamp(file_name, current)
+						|| stamp.index_bytes != current.index_bytes || stamp.block_bytes != current.block_bytes
+						|| stamp.index_mtime_ns != current.index_mtime_ns || stamp.block_mtime_ns != current.block_mtime_ns)
+				{
+					cerr<<"[WARN] "<<file_name<<".sindex does not match "<<file_name<<".index, ignored."<<endl;
+					return false;
+				}
+				if(!ids.Load(fin) || !bounds.Load(fin) || bounds.Size() != ids.Size() + 1)
+				{
+					ids.Init(0, 0);
+					bounds.Init(0, 0);
+					return false;
+				}
+				return true;
+			}
+	};
+
+	// description: build <name>.sindex from <name>.index
+	// parameters:
+	//  [IN] file -- the database name
+	// return:
+	//  true -- success
+	inline bool BuildSuccinctIndexFile(const char* file)
+	{
+		std::string file_name(file);
+		ConstructVirtualMemoryDataFileName(file_name);
+
+		SuccinctDataIndex succinct_index;
+		if(!succinct_index.Build(file_name))
+		{
+			cerr<<file_name<<".index is not written in increasing id order, succinct index not built."<<endl;
+			remove((file_name + ".sindex").c_str());
+			return false;
+		}
+		if(!succinct_index.Save(file_name))
+		{
+			cerr<<file_name<<".sindex can not be written."<<endl;
+			remove((file_name + ".sindex").c_str());
+			return false;
+		}
+		return true;
+	}
 	
     // description: scan block data via this class's instance
     template<typename BlockData>
@@ -106,78 +389,171 @@ namespace kaijiang_api
             return rsc->scanner->Process(data_unit, sequence_num, rsc->resource);
         }
 
-    template<typename BlockData>
-        class VirtualMemoryData
-        {
-            public:
-                // description: handle each block data unit when scanning the block list
-                // parameters:
-                //  [IN] data_unit -- each data unit
-                //  [IN] sequence_num -- current sequence 
-                //  [IN/OUT] resource -- self-defined resource
-                // return:
-                //  true -- success
-                typedef bool (*HandleBlockDataUnit)(const BlockData& data_unit, const uint32_t sequence_num, void* resource);
-
-            private:
-                std::vector<VirtualMemoryDataIndex> sorted_binary_index_list;
-                VirtualMemoryMapper* virtual_memory_mapper;
-                uint32_t block_size;
-
-            private:
-                // descrption: get data location
-                // parameters:
-                //  [IN] id -- the id
-                //  [OUT] off -- the offset in the block list
-                //  [OUT] size -- the block data size
-                // return:
-                //  true -- success
-                bool GetLocation(const uint64_t id, uint64_t& off, uint32_t& size) const 
+    // description: immutable part of an opened database, the block mapping and the index.
+    //  it is shared by every copy of a VirtualMemoryData and never changes after construction,
+    //  so any number of threads may read it concurrently.
+    class VirtualMemoryDataCore
+    {
+        private:
+            std::vector<VirtualMemoryDataIndex> sorted_binary_index_list;
+            SuccinctDataIndex succinct_index;
+            bool use_succinct_index;
+            VirtualMemoryMapper* virtual_memory_mapper;
+            uint64_t block_size;
+
+        private:
+            VirtualMemoryDataCore(const VirtualMemoryDataCore&);
+            VirtualMemoryDataCore& operator=(const VirtualMemoryDataCore&);
+
+        public:
+            // description: open the database
+            // parameters:
+            //  [IN] file_name -- the database name, without extension
+            //  [IN] succinct -- see VirtualMemoryData
+            //  [IN] block_data_bytes -- sizeof(BlockData)
+            VirtualMemoryDataCore(const std::string& file_name, const bool succinct, const size_t block_data_bytes)
+            {
+                block_size = 0;
+                use_succinct_index = false;
+                virtual_memory_mapper = NULL;
+                // prefer the saved succinct index, then the streaming build, which never holds the
+                // VirtualMemoryDataIndex list; only fall back to loading the list when both fail
+                if(succinct && (succinct_index.Load(file_name) || succinct_index.Build(file_name)))
                 {
-                    if(id == 0 || sorted_binary_index_list.size() == 0)
+                    use_succinct_index = true;
+                }
+                else
+                {
+                    if(!LoadVirtualMemoryDataIndex(file_name, sorted_binary_index_list))
+                        return;
+                    if(succinct)
                     {
-#ifdef DEBUG
-                        cerr<<"id == 0 || sorted_binary_index_list.size() == 0, id="<<id<<endl;
-#endif
-                        return false;
+                        if(succinct_index.Build(sorted_binary_index_list))
+                        {
+                            use_succinct_index = true;
+                            std::vector<VirtualMemoryDataIndex>().swap(sorted_binary_index_list);
+                        }
+                        else
+                        {
+                            cerr<<"[WARN] "<<file_name<<".index is not contiguous in id order, using plain index."<<endl;
+                        }
                     }
-                    VirtualMemoryDataIndex index_query;
-                    index_query.id = id;
-                    std::vector<VirtualMemoryDataIndex>::const_iterator low_index = std::lower_bound (sorted_binary_index_list.begin(), 
-                            sorted_binary_index_list.end(), 
-                            index_query, 
-                            CmpMemoryIndexId);
-
-                    if(low_index == sorted_binary_index_list.end())
+                }
+                if(use_succinct_index)
+                    cerr<<"[INFO] succinct_index_bytes = "<<succinct_index.MemoryBytes()<<endl;
+
+                // binary_block_file_handle
+                std::string block_file_name = file_name + ".block";
+                virtual_memory_mapper = new VirtualMemoryMapper(block_file_name.c_str());
+                block_size = virtual_memory_mapper->GetSize()/block_data_bytes;
+                cerr<<"[INFO] virtual_memory_data_size = "<<block_size<<endl;
+            }
+
+            virtual ~VirtualMemoryDataCore()
+            {
+                if(virtual_memory_mapper)delete virtual_memory_mapper; 
+            }
+
+            // descrption: get data location
+            // parameters:
+            //  [IN] id -- the id
+            //  [OUT] off -- the offset in the block list
+            //  [OUT] size -- the block data size
+            // return:
+            //  true -- success
+            bool GetLocation(const uint64_t id, uint64_t& off, uint32_t& size) const
+            {
+                if(use_succinct_index)
+                {
+                    if(id == 0 || !succinct_index.Find(id, off, size) || off + size > block_size)
                     {
 #ifdef DEBUG
                         cerr<<"find no block infor by id="<<id<<endl;
 #endif
                         return false;
                     }
+                    return true;
+                }
 
-                    if(low_index->id != id)
-                    {
+                if(id == 0 || sorted_binary_index_list.size() == 0)
+                {
 #ifdef DEBUG
-                        cerr<<"find no block infor by id="<<id<<endl;
+                    cerr<<"id == 0 || sorted_binary_index_list.size() == 0, id="<<id<<endl;
 #endif
-                        return false;
-                    }
-                    if(low_index->off + low_index->size > block_size)
-                    {
+                    return false;
+                }
+                VirtualMemoryDataIndex index_query;
+                index_query.id = id;
+                std::vector<VirtualMemoryDataIndex>::const_iterator low_index = std::lower_bound (sorted_binary_index_list.begin(), 
+                        sorted_binary_index_list.end(), 
+                        index_query, 
+                        CmpMemoryIndexId);
+
+                if(low_index == sorted_binary_index_list.end())
+                {
 #ifdef DEBUG
-                        cerr<<"find no block infor by id="<<id<<endl;
+                    cerr<<"find no block infor by id="<<id<<endl;
 #endif
-                        return false;
-                    }
+                    return false;
+                }
 
-                    off = low_index->off;
-                    size = low_index->size;
+                if(low_index->id != id)
+                {
 #ifdef DEBUG
-                    cerr<<id<<", "<<off<<", "<<size<<endl;
+                    cerr<<"find no block infor by id="<<id<<endl;
 #endif
+                    return false;
+                }
+                if(low_index->off + low_index->size > block_size)
+                {
+#ifdef DEBUG
+                    cerr<<"find no block infor by id="<<id<<endl;
+#endif
+                    return false;
+                }
 
-                    return true;
+                off = low_index->off;
+                size = low_index->size;
+#ifdef DEBUG
+                cerr<<id<<", "<<off<<", "<<size<<endl;
+#endif
+
+                return true;
+            }
+
+            inline const void* GetData() const {return virtual_memory_mapper ? virtual_memory_mapper->GetData() : NULL;}
+
+            inline uint64_t IndexSize() const {return use_succinct_index ? succinct_index.Size() : sorted_binary_index_list.size();}
+
+            inline uint64_t BlockSize() const {return block_size;}
+    };
+
+    // description: reader of the database. the mapping and the index live in a shared immutable
+    //  VirtualMemoryDataCore, so copying a VirtualMemoryData is O(1) and copies share one mapping.
+    //  const members may be called from any number of threads at once, on one object or on copies;
+    //  assigning to an object while other threads use that same object is not safe.
+    template<typename BlockData>
+        class VirtualMemoryData
+        {
+            public:
+                // description: handle each block data unit when scanning the block list
+                // parameters:
+                //  [IN] data_unit -- each data unit
+                //  [IN] sequence_num -- current sequence 
+                //  [IN/OUT] resource -- self-defined resource
+                // return:
+                //  true -- success
+                typedef bool (*HandleBlockDataUnit)(const BlockData& data_unit, const uint32_t sequence_num, void* resource);
+
+            private:
+                std::shared_ptr<const VirtualMemoryDataCore> core;
+
+            private:
+                bool GetLocation(const uint64_t id, uint64_t& off, uint32_t& size) const
+                {
+                    if(!core)
+                        return false;
+                    return core->GetLocation(id, off, size);
                 }
 
                 // desciption: scan specified block data list
@@ -192,10 +568,10 @@ namespace kaijiang_api
                 {
                     try
                     {
-                        const BlockData* block_data = (const BlockData*)(virtual_memory_mapper->GetData());
+                        const BlockData* block_data = (const BlockData*)(core->GetData());
                         uint32_t iblock = 0;
                         uint32_t index_of_blockdata = 0;
-                        for(uint32_t index = off; index < off + size; index++)
+                        for(uint64_t index = off; index < off + size; index++)
                         {
 #ifdef DEBUG
                             cerr<<"<"<<index<<" "<<iblock<<" "<<block_data[index]<<">"<<endl;
@@ -221,84 +597,56 @@ namespace kaijiang_api
                 //  nothing
                 // return:
                 //  size
-                inline uint32_t IndexSize() const {return sorted_binary_index_list.size();}
+                inline uint32_t IndexSize() const {return core ? core->IndexSize() : 0;}
 
                 // description: get block size,block is unit of data
                 // parameters:
                 //  nothing
                 // return:
                 // size
-                inline uint32_t BlockSize() const{return block_size;}
+                inline uint64_t BlockSize() const{return core ? core->BlockSize() : 0;}
 
-                VirtualMemoryData(const VirtualMemoryData& other)
+                VirtualMemoryData()
                 {
-                    virtual_memory_mapper = new VirtualMemoryMapper(*(other.virtual_memory_mapper));
-                    sorted_binary_index_list = other.sorted_binary_index_list;
-                    block_size = other.block_size;
                 }
 
-                VirtualMemoryData()
+                VirtualMemoryData(const VirtualMemoryData& other) : core(other.core)
                 {
-                    virtual_memory_mapper = NULL;
-                    block_size = 0;
                 }
 
-                VirtualMemoryData& operator=(const VirtualMemoryData& other)
+                VirtualMemoryData(VirtualMemoryData&& other) : core(std::move(other.core))
                 {
-                    if(&other == this)
-                        return *this;
-
-                    if(this->virtual_memory_mapper) delete this->virtual_memory_mapper;
+                }
 
-                    this->sorted_binary_index_list = other.sorted_binary_index_list;
-                    this->virtual_memory_mapper = new VirtualMemoryMapper(*other.virtual_memory_mapper);
-                    block_size = other.block_size;
+                VirtualMemoryData& operator=(const VirtualMemoryData& other)
+                {
+                    core = other.core;
+                    return *this;
+                }
 
+                VirtualMemoryData& operator=(VirtualMemoryData&& other)
+                {
+                    core = std::move(other.core);
                     return *this;
                 }
 
-                VirtualMemoryData(const char* file)
+                // description: open the database
+                // parameters:
+                //  [IN] file -- the database name, <name>.block/<name>.index
+                //  [IN] succinct -- keep the index as a SuccinctDataIndex (a few bytes per id) instead of
+                //   the VirtualMemoryDataIndex list; <name>.sindex is used if present, otherwise it is built
+                //   from <name>.index, falling back to the plain list if the lists are not back to back
+                VirtualMemoryData(const char* file, bool succinct = false)
                 {
-                    block_size = 0;
                     std::string file_name(file);
                     ConstructVirtualMemoryDataFileName(file_name);
-
-                    virtual_memory_mapper = NULL;
-                    std::ifstream binar_index_file((file_name + ".index").c_str(), ios::binary);
-                    if(!binar_index_file.is_open())
-                    {
-                        cerr<<file_name<<".index can not be opened."<<endl;
-                        return;
-                    }
-
-                    VirtualMemoryDataIndex index;
-                    while(!binar_index_file.read((char*)(&index), sizeof(VirtualMemoryDataIndex)).eof())
-                    {
-#ifdef DEBUG
-                        cerr<<"id = "<<index.id<<", off = "<<index.off<<", size = "<<index.size<<endl;
-#endif
-                        sorted_binary_index_list.push_back(index);
-                    }
-#ifdef DEBUG
-                    cerr<<sorted_binary_index_list.size()<<endl;
-#endif
-                    // sort index by id
-                    sort(sorted_binary_index_list.begin(), sorted_binary_index_list.end(), CmpMemoryIndexId);
-                    binar_index_file.close();
-
-                    // binary_block_file_handle
-                    std::string block_file_name = file_name + ".block";
-                    virtual_memory_mapper = new VirtualMemoryMapper(block_file_name.c_str());
-                    block_size = virtual_memory_mapper->GetSize()/sizeof(BlockData);
-                    cerr<<"[INFO] virtual_memory_data_size = "<<block_size<<endl;
+                    core.reset(new VirtualMemoryDataCore(file_name, succinct, sizeof(BlockData)));
                 }
 
                 virtual ~VirtualMemoryData()
                 {
-                    if(virtual_memory_mapper)delete virtual_memory_mapper; 
                 }
 
-
                 // description: scan the block list
                 // parameters:
                 //  [IN] id -- the id that indexes the block list
@@ -357,6 +705,25 @@ namespace kaijiang_api
                     return block_data;
                 }
 
+                // description: get block data list without copying, it points into the mapping
+                //  and stays valid as long as this object
+                // parameters:
+                //  [IN] id -- the id
+                //  [OUT] the_block_size -- block data size of the list
+                // return:
+                //  data pointer, NULL if not found
+                const BlockData* GetList(const uint64_t id, uint32_t& the_block_size) const
+                {
+                    the_block_size = 0;
+                    uint64_t off = 0;
+                    uint32_t size = 0;
+                    if(!GetLocation(id, off, size))
+                        return NULL;
+
+                    the_block_size = size;
+                    return (const BlockData*)(core->GetData()) + off;
+                }
+
                 // description: get specified BlockData in specified id's list, in other words, return just one data object if there exists
                 // parameters:
                 //  [IN] id -- the id
@@ -380,7 +747,7 @@ namespace kaijiang_api
                     if(index >= size)
                         return false;
 
-                    const BlockData* block_data = (const BlockData*)(virtual_memory_mapper->GetData());
+                    const BlockData* block_data = (const BlockData*)(core->GetData());
                     (*data) = BlockData(block_data[off + index]);
                     return true; 
                 }
@@ -396,6 +763,8 @@ namespace kaijiang_api
                 VirtualMemoryDataIndex data_index;
                 bool index_flushed;
                 uint32_t block_size_writed;
+                std::string file_name;
+                bool build_succinct_index;
             public:
                 void FlushIndex()
                 {
@@ -409,7 +778,10 @@ namespace kaijiang_api
                     }
                 }
 
-                void Close()
+                // description: flush and close the files, and build <name>.sindex if asked in Open
+                // return:
+                //  true -- success, false if the succinct index was asked for but not built
+                bool Close()
                 {
                     FlushIndex();
                     block_size_writed = 0;
@@ -417,10 +789,16 @@ namespace kaijiang_api
                     data_index.size = 0;
                     data_index.off = 0;
 
+                    bool opened = index_fout.is_open();
                     if(block_fout.is_open())
                         block_fout.close();
                     if(index_fout.is_open())
                         index_fout.close();
+                    bool succeeded = true;
+                    if(opened && build_succinct_index)
+                        succeeded = BuildSuccinctIndexFile(file_name.c_str());
+                    build_succinct_index = false;
+                    return succeeded;
                 }
 
                 VirtualMemoryDataWriter()
@@ -430,6 +808,7 @@ namespace kaijiang_api
                     data_index.off = 0;
                     data_index.size = 0;
                     block_size_writed = 0;
+                    build_succinct_index = false;
                 }
 
                 virtual ~VirtualMemoryDataWriter()
@@ -437,12 +816,19 @@ namespace kaijiang_api
                     Close();
                 }
 
-                bool Open(const char* file)
+                // description: open the database for writing
+                // parameters:
+                //  [IN] file -- the database name
+                //  [IN] succinct -- also build <name>.sindex on Close, ids must be switched in increasing order
+                // return:
+                //  true -- success
+                bool Open(const char* file, bool succinct = false)
                 {
                     Close();
 
-                    std::string file_name(file);
+                    file_name = file;
                     ConstructVirtualMemoryDataFileName(file_name);
+                    build_succinct_index = succinct;
                     block_fout.open((file_name + ".block").c_str(), ios::binary);
                     if(!block_fout.is_open())
                         return false;
@@ -450,6 +836,8 @@ namespace kaijiang_api
                     index_fout.open((file_name + ".index").c_str(), ios::binary);
                     if(!index_fout.is_open())
                         return false;
+                    // a succinct index of the old content must not outlive it
+                    remove((file_name + ".sindex").c_str());
 
                     return true;
                 }
@@ -464,6 +852,7 @@ namespace kaijiang_api
                     index_id_set.insert(id);
                     data_index.id = id;
                     index_flushed = false;
+                    return true;
                 }
 
                 // description: 
@@ -476,6 +865,17 @@ namespace kaijiang_api
 
                     return true;
                 }
+
+                // description: write a block data array to the current id's list
+                bool Write(const BlockData* block_data, const uint32_t size, bool flush_index = false)
+                {
+                    block_fout.write((const char*)(block_data), sizeof(BlockData) * size);
+                    data_index.size += size;
+                    block_size_writed += size;
+                    if(flush_index) FlushIndex();
+
+                    return true;
+                }
         };
 };
 
@@ -27,20 +27,22 @@ namespace kaijiang_api
 			//  nothing
 			void Clean()
 			{
+				if(virtual_memory)
+					munmap(virtual_memory, size);
 				if(file_handle >= 0)
 					close(file_handle);
+				file_handle = -1;
 				file_name = "";
-				munmap(virtual_memory, size);
 				virtual_memory = NULL;
 				size = 0;
 			}
-		public:
-			// description: constructor
+
+			// description: open and map the file, this must be clean
 			// parameters:
-			//  [IN] binary_data_file -- the file
+			//  [IN] data_file -- the file
 			// return:
 			//  nothing
-			VirtualMemoryMapper(const char* data_file)
+			void Open(const char* data_file)
 			{
 				size = 0;
 				virtual_memory = NULL;
@@ -55,6 +57,7 @@ namespace kaijiang_api
 				{
                     std::cerr << data_file << " is null." << std::endl;
 					close(file_handle);
+					file_handle = -1;
 					return;
 				}
 				virtual_memory = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, file_handle, 0);
@@ -63,15 +66,32 @@ namespace kaijiang_api
 					virtual_memory = NULL;
                     std::cerr << data_file << " map to virtual memory failed." << std::endl;
 					close(file_handle);
+					file_handle = -1;
 					return;
 				}
 				size = st.st_size;
 				file_name = std::string(data_file);
 			}
+		public:
+			// description: constructor
+			// parameters:
+			//  [IN] binary_data_file -- the file
+			// return:
+			//  nothing
+			VirtualMemoryMapper(const char* data_file)
+			{
+				Open(data_file);
+			}
 
+			// description: copy maps the same file again, share a VirtualMemoryData instead of
+			//  copying mappers when possible
 			VirtualMemoryMapper(const VirtualMemoryMapper& another)
 			{
-				VirtualMemoryMapper(another.file_name.c_str());
+				file_handle = -1;
+				virtual_memory = NULL;
+				size = 0;
+				if(another.virtual_memory)
+					Open(another.file_name.c_str());
 			}
 
 			VirtualMemoryMapper& operator=(const VirtualMemoryMapper& another)
@@ -80,8 +100,8 @@ namespace kaijiang_api
 					return *this;
 				
 				Clean();
-
-				VirtualMemoryMapper(another.file_name.c_str());
+				if(another.virtual_memory)
+					Open(another.file_name.c_str());
 
 				return *this;
 			}
@@ -119,7 +139,7 @@ namespace kaijiang_api
 			const inline std::string GetFileName() const {return file_name;}
 
 			// description: get size
-			inline uint32_t GetSize() const {return size; }
+			inline size_t GetSize() const {return size; }
 	};
 };
 